@@ -1,4 +1,6 @@
 #include "http_server.h"
+#include "wifi_link.h"
+#include "pico/cyw43_arch.h"
 #include "lwip/apps/httpd.h"
 #include <cstdio>
 #include <cstring>
@@ -32,14 +34,50 @@ const char *temperature_cgi_handler(int iIndex, int iNumParams, char *pcParam[],
     return json_buffer;
 }
 
-// Registers CGI handler and starts the HTTP server
-void web_server_init(void)
+// CGI handler for /link endpoint
+// Returns a JSON string with the WiFi recovery metrics kept by the link supervisor
+// and the most recent outages, newest first
+// Runs in the lwIP context, the supervisor only updates these under the lwIP lock
+const char *link_cgi_handler(int iIndex, int iNumParams, char *pcParam[], char *pcValue[])
 {
-    httpd_init();
+    static char json_buffer[896];
+    const wifi_link_stats *stats = wifi_link_get_stats();
+
+    int len = snprintf(json_buffer, sizeof(json_buffer),
+                       "{\"outages\":%lu,\"reconnectAttempts\":%lu,\"lastReconnectMs\":%lu,"
+                       "\"longestReconnectMs\":%lu,\"outageSamples\":%lu,\"totalOutageSamples\":%lu,"
+                       "\"history\":[",
+                       (unsigned long)stats->outages, (unsigned long)stats->reconnect_attempts,
+                       (unsigned long)stats->last_reconnect_ms, (unsigned long)stats->longest_reconnect_ms,
+                       (unsigned long)stats->outage_samples, (unsigned long)stats->total_outage_samples);
 
+    const wifi_outage_record *outage;
+    for (uint32_t i = 0; (outage = wifi_link_get_outage(i)) != nullptr; i++)
+    {
+        len += snprintf(json_buffer + len, sizeof(json_buffer) - len,
+                        "%s{\"startMs\":%lu,\"durationMs\":%lu,\"samples\":%lu}",
+                        i ? "," : "", (unsigned long)outage->start_ms,
+                        (unsigned long)outage->duration_ms, (unsigned long)outage->samples);
+    }
+    snprintf(json_buffer + len, sizeof(json_buffer) - len, "]}");
+
+    return json_buffer;
+}
+
+// Registers CGI handlers and starts the HTTP server
+// Call once, the first time the link is up. httpd listens on any address so it
+// keeps working when the IP changes after a reconnect
+// lwIP runs in the background so the PCBs are set up under the lwIP lock
+void web_server_init(void)
+{
     static const tCGI cgi_handlers[] = {
-        {"/temperature", temperature_cgi_handler}};
-    http_set_cgi_handlers(cgi_handlers, 1);
+        {"/temperature", temperature_cgi_handler},
+        {"/link", link_cgi_handler}};
+
+    cyw43_arch_lwip_begin();
+    httpd_init();
+    http_set_cgi_handlers(cgi_handlers, 2);
+    cyw43_arch_lwip_end();
 
     printf("HTTP server initialized\n");
 }
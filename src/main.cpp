@@ -4,6 +4,7 @@
 #include "dht11.h"
 #include "u8g2.h"
 #include "http_server.h"
+#include "wifi_link.h"
 #include <cstdio>
 #include <cstring>
 
@@ -37,6 +38,14 @@ static int last_button_state = 0;
 static unsigned long last_press_time = 0;
 const unsigned long debounce_delay = 50;
 
+// Sensor is read every 3 seconds, the main loop itself runs every 20ms so the
+// button and WiFi link supervisor stay responsive between readings
+const uint32_t sample_interval = 3000;
+const uint32_t loop_delay = 20;
+
+// Give up on the initial join after 30 seconds and let the link supervisor retry
+const uint32_t initial_join_timeout = 30000;
+
 // Loading animation frames (32x32 bitmaps)
 #define FRAME_WIDTH 32
 #define FRAME_HEIGHT 32
@@ -124,28 +133,90 @@ static void display_print_line(const char *msg, int line)
     u8g2_SendBuffer(&u8g2);
 }
 
-// Draw two lines and send once, used to update temp and humidity display simultaneously
-static void display_print_two_lines(const char *l1, const char *l2, int line1, int line2)
+// Whole seconds until the next reconnect attempt, rounded up so it never shows 0 early
+static uint32_t link_retry_seconds(void)
+{
+    return (wifi_link_retry_in_ms() + 999) / 1000;
+}
+
+// Formats the WiFi link state for the bottom line of the OLED
+// e.g. "WiFi: 192.168.1.42", "WiFi: joining..." or "WiFi down, retry 8s"
+static void format_link_status(char *buf, size_t len)
 {
+    switch (wifi_link_get_state())
+    {
+    case WIFI_LINK_UP:
+        snprintf(buf, len, "WiFi: %s", wifi_link_ip_str());
+        break;
+    case WIFI_LINK_JOINING:
+        snprintf(buf, len, "WiFi: joining...");
+        break;
+    case WIFI_LINK_DOWN:
+        snprintf(buf, len, "WiFi down, retry %lus", (unsigned long)link_retry_seconds());
+        break;
+    }
+}
+
+// Draw the temp and humidity lines and the WiFi link state underneath, then send once
+// l2 may be null when there is only one line to show (e.g. a sensor error)
+static void display_print_status(const char *l1, const char *l2)
+{
+    char link_line[32];
+    format_link_status(link_line, sizeof(link_line));
+
     u8g2_SetFont(&u8g2, u8g2_font_6x10_tr);
     u8g2_ClearBuffer(&u8g2);
-    u8g2_DrawStr(&u8g2, 0, 10 + line1 * 10, l1);
-    u8g2_DrawStr(&u8g2, 0, 10 + line2 * 10, l2);
+    u8g2_DrawStr(&u8g2, 0, 20, l1);
+    if (l2)
+        u8g2_DrawStr(&u8g2, 0, 30, l2);
+    u8g2_DrawStr(&u8g2, 0, 60, link_line);
     u8g2_SendBuffer(&u8g2);
 }
 
+// Draws the latest DHT11 reading in the selected unit, or "Sensor error" if the read failed
+static void display_reading(bool ok, float temp, float humidity)
+{
+    if (!ok)
+    {
+        display_print_status("Sensor error", nullptr);
+        return;
+    }
+
+    char line1[32];
+    if (use_celsius)
+    {
+        snprintf(line1, sizeof(line1), "Temp: %.2fC", temp);
+    }
+    else
+    {
+        float tempF = (temp * 9.0 / 5.0) + 32.0;
+        snprintf(line1, sizeof(line1), "Temp: %.2fF", tempF);
+    }
+
+    char line2[32];
+    snprintf(line2, sizeof(line2), "Hum: %.2f%%", humidity);
+    display_print_status(line1, line2);
+}
+
 // Displays a loading animation while connecting to WiFi
 // Shows "Connecting to wifi..." text and animated frames below
-// Returns when WiFi is connected
+// Returns when WiFi is connected, the join fails, or initial_join_timeout passes
 static void display_loading_animation(void)
 {
     int frame = 0;
     const uint32_t min_display_time = 2000; // minimum 2 seconds
     uint32_t start_time = to_ms_since_boot(get_absolute_time());
 
-    while (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) != CYW43_LINK_UP ||
-           (to_ms_since_boot(get_absolute_time()) - start_time) < min_display_time)
+    while (true)
     {
+        uint32_t elapsed = to_ms_since_boot(get_absolute_time()) - start_time;
+        int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+
+        // FAIL, NONET and BADAUTH are negative, no point waiting out the timeout
+        bool done = status == CYW43_LINK_UP || status < 0 || elapsed >= initial_join_timeout;
+        if (done && elapsed >= min_display_time)
+            break;
+
         u8g2_ClearBuffer(&u8g2);
 
         // Display "Connecting to wifi..." text at the top
@@ -188,13 +259,19 @@ int main()
     printf("Connecting to Wi-Fi...\n");
 
     // Start WiFi connection asynchronously (non-blocking)
+    uint32_t join_start_time = to_ms_since_boot(get_absolute_time());
     cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASS, CYW43_AUTH_WPA2_AES_PSK);
 
     // Show loading animation while connecting
     display_loading_animation();
 
+    // Hand the link over to the supervisor, it retries in the background if this join failed
+    // Any outage is measured from join_start_time so the boot join counts towards time-to-reconnect
+    wifi_link_init(WIFI_SSID, WIFI_PASS, join_start_time);
+    bool server_started = false;
+
     // Check if connection succeeded
-    if (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP)
+    if (wifi_link_get_state() == WIFI_LINK_UP)
     {
         printf("Wi-Fi connected.\n");
         display_clear();
@@ -208,10 +285,10 @@ int main()
 
         // Start HTTP server
         web_server_init();
+        server_started = true;
 
         // Print IP address to console and OLED
-        char ip_str[32];
-        snprintf(ip_str, sizeof(ip_str), "%s", ip4addr_ntoa(netif_ip4_addr(netif_list)));
+        const char *ip_str = wifi_link_ip_str();
         printf("IP: %s\n", ip_str);
 
         display_clear();
@@ -224,7 +301,7 @@ int main()
     }
     else
     {
-        printf("Wi-Fi connect failed\n");
+        printf("Wi-Fi connect failed, will keep retrying\n");
         display_print_line("WiFi connect fail", 1);
     }
 
@@ -232,14 +309,21 @@ int main()
     DHT11 dht(DHT_PIN);
     sleep_ms(2000);
 
-    // Main loop: read DHT11 and update OLED display every 3 seconds
-    // Then attempt to upload reading to HTTP server
+    // Main loop: poll the button and WiFi link every pass, read DHT11 and update
+    // OLED display every 3 seconds, then attempt to upload reading to HTTP server
+    uint32_t last_sample_time = to_ms_since_boot(get_absolute_time()) - sample_interval;
+    float temp = 0, humidity = 0;
+    bool reading_ok = false;
+    uint32_t shown_retry_seconds = 0;
+
     while (true)
     {
         // Handle button press for temperature unit toggle
         int current_button_state = gpio_get(BUTTON_PIN);
         uint32_t current_time = to_ms_since_boot(get_absolute_time());
 
+        bool redraw = false;
+
         // Toggle temp unit on button press with debounce
         if (current_button_state == 1 && last_button_state == 0 &&
             (current_time - last_press_time) > debounce_delay)
@@ -247,37 +331,51 @@ int main()
             use_celsius = !use_celsius;
             last_press_time = current_time;
             printf("Temperature unit toggled to %s\n", use_celsius ? "Celsius" : "Fahrenheit");
+            redraw = true;
         }
         last_button_state = current_button_state;
 
-        float temp, humidity;
-        if (dht.read(&temp, &humidity))
+        // Reconnect in the background, redraw so the OLED shows the new link state
+        if (wifi_link_poll())
         {
-            printf("Temp: %.2fC, Hum: %.2f%%\n", temp, humidity);
-            char line1[32];
+            redraw = true;
 
-            if (use_celsius)
-            {
-                snprintf(line1, sizeof(line1), "Temp: %.2fC", temp);
-            }
-            else
+            // If the first join failed httpd is started on the first successful reconnect
+            if (!server_started && wifi_link_get_state() == WIFI_LINK_UP)
             {
-                float tempF = (temp * 9.0 / 5.0) + 32.0;
-                snprintf(line1, sizeof(line1), "Temp: %.2fF", tempF);
+                web_server_init();
+                server_started = true;
             }
+        }
 
-            char line2[32];
-            snprintf(line2, sizeof(line2), "Hum: %.2f%%", humidity);
-            display_print_two_lines(line1, line2, 1, 2);
-
-            web_server_update_data(temp, humidity);
+        // Keep the "retry Ns" countdown ticking every second while the link is down
+        uint32_t retry_seconds = link_retry_seconds();
+        if (retry_seconds != shown_retry_seconds)
+        {
+            shown_retry_seconds = retry_seconds;
+            redraw = true;
         }
-        else
+
+        if ((current_time - last_sample_time) >= sample_interval)
         {
-            printf("DHT read error.\n");
-            display_print_line("Sensor error", 1);
+            last_sample_time = current_time;
+            reading_ok = dht.read(&temp, &humidity);
+            if (reading_ok)
+            {
+                printf("Temp: %.2fC, Hum: %.2f%%\n", temp, humidity);
+                web_server_update_data(temp, humidity);
+                wifi_link_record_sample();
+            }
+            else
+            {
+                printf("DHT read error.\n");
+            }
+            redraw = true;
         }
 
-        sleep_ms(3000);
+        if (redraw)
+            display_reading(reading_ok, temp, humidity);
+
+        sleep_ms(loop_delay);
     }
 }
\ No newline at end of file
@@ -0,0 +1,265 @@
+/*
+    WiFi link supervisor
+    Polled from the main loop, never blocks. Watches the CYW43 link status and
+    rejoins the access point with exponential backoff whenever the link drops.
+*/
+
+#include "wifi_link.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/netif.h"
+#include "lwip/ip4_addr.h"
+#include <cstdio>
+
+// Backoff starts at 1 second and doubles after every failed attempt up to 1 minute
+#define BACKOFF_MIN_MS 1000
+#define BACKOFF_MAX_MS 60000
+
+// Give up on a join attempt that has not produced an IP address after 20 seconds
+#define JOIN_TIMEOUT_MS 20000
+
+static const char *wifi_ssid = nullptr;
+static const char *wifi_pass = nullptr;
+
+static wifi_link_state state = WIFI_LINK_DOWN;
+static wifi_link_stats stats = {};
+static wifi_outage_record outages[WIFI_LINK_OUTAGE_HISTORY] = {};
+
+// stats and outages[] are read by the /link CGI handler in the lwIP background context,
+// so every update is made under cyw43_arch_lwip_begin()/end() to keep them consistent
+
+static uint32_t outage_start_ms = 0;
+static uint32_t join_start_ms = 0;
+static uint32_t next_attempt_ms = 0;
+static uint32_t backoff_ms = BACKOFF_MIN_MS;
+
+static uint32_t ip_addr = 0;
+static char ip_str[16] = "";
+
+static uint32_t now_ms(void)
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Record for the outage in progress (or the most recent one)
+static wifi_outage_record *current_outage(void)
+{
+    return &outages[(stats.outages - 1) % WIFI_LINK_OUTAGE_HISTORY];
+}
+
+// Updates ip_str if the STA address changed, returns true if it did
+// Reading the 32 bit address is atomic so the lwIP lock is only taken to format it
+static bool refresh_ip(void)
+{
+    const ip4_addr_t *addr = netif_ip4_addr(&cyw43_state.netif[CYW43_ITF_STA]);
+    if (ip4_addr_get_u32(addr) == ip_addr)
+        return false;
+
+    cyw43_arch_lwip_begin();
+    ip_addr = ip4_addr_get_u32(addr);
+    ip4addr_ntoa_r(addr, ip_str, sizeof(ip_str));
+    cyw43_arch_lwip_end();
+    return true;
+}
+
+static void begin_outage(uint32_t now)
+{
+    cyw43_arch_lwip_begin();
+    stats.outages++;
+    stats.outage_samples = 0;
+    *current_outage() = {now, 0, 0};
+    cyw43_arch_lwip_end();
+
+    outage_start_ms = now;
+    backoff_ms = BACKOFF_MIN_MS;
+    next_attempt_ms = now + backoff_ms;
+    ip_addr = 0;
+    ip_str[0] = '\0';
+    state = WIFI_LINK_DOWN;
+}
+
+// Doubles the backoff after a failed attempt and waits that long before the next one
+static void schedule_retry(uint32_t now)
+{
+    backoff_ms = backoff_ms * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : backoff_ms * 2;
+    next_attempt_ms = now + backoff_ms;
+    state = WIFI_LINK_DOWN;
+}
+
+static void link_up(uint32_t now)
+{
+    // No outage to measure if the first join in main() succeeded
+    if (stats.outages > 0)
+    {
+        cyw43_arch_lwip_begin();
+        stats.last_reconnect_ms = now - outage_start_ms;
+        current_outage()->duration_ms = stats.last_reconnect_ms;
+        if (stats.last_reconnect_ms > stats.longest_reconnect_ms)
+            stats.longest_reconnect_ms = stats.last_reconnect_ms;
+        cyw43_arch_lwip_end();
+
+        printf("Wi-Fi reconnected after %lu ms (%lu samples taken offline)\n",
+               (unsigned long)stats.last_reconnect_ms, (unsigned long)stats.outage_samples);
+    }
+
+    backoff_ms = BACKOFF_MIN_MS;
+    refresh_ip();
+    state = WIFI_LINK_UP;
+    printf("IP: %s\n", ip_str);
+}
+
+static void start_join(uint32_t now)
+{
+    // Drop a half finished association before trying again. cyw43_wifi_link_status()
+    // reports CYW43_LINK_JOIN once associated, whether or not DHCP has given us an address.
+    // Leaving when not associated would queue a disassoc event that can reset the new join.
+    cyw43_arch_lwip_begin();
+    if (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_JOIN)
+        cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    stats.reconnect_attempts++;
+    cyw43_arch_lwip_end();
+
+    join_start_ms = now;
+
+    if (cyw43_arch_wifi_connect_async(wifi_ssid, wifi_pass, CYW43_AUTH_WPA2_AES_PSK))
+    {
+        printf("Wi-Fi join could not be started\n");
+        schedule_retry(now);
+        return;
+    }
+
+    printf("Wi-Fi reconnect attempt %lu\n", (unsigned long)stats.reconnect_attempts);
+    state = WIFI_LINK_JOINING;
+}
+
+// Takes over from the initial join in main(). If the link is not up yet the
+// failed first join is treated as an outage and retried from here on.
+// boot_join_ms is when main() issued that join, so the outage covers the time already spent on it.
+void wifi_link_init(const char *ssid, const char *pass, uint32_t boot_join_ms)
+{
+    wifi_ssid = ssid;
+    wifi_pass = pass;
+
+    if (cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP)
+    {
+        refresh_ip();
+        state = WIFI_LINK_UP;
+    }
+    else
+    {
+        begin_outage(boot_join_ms);
+        next_attempt_ms = now_ms() + backoff_ms;
+    }
+}
+
+// Advances the supervisor state machine, call this every pass of the main loop
+// Returns true if the link state or IP address changed so the caller can redraw
+bool wifi_link_poll(void)
+{
+    uint32_t now = now_ms();
+    int tcpip_status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+
+    switch (state)
+    {
+    case WIFI_LINK_UP:
+        if (tcpip_status != CYW43_LINK_UP)
+        {
+            printf("Wi-Fi link lost (status %d)\n", tcpip_status);
+            begin_outage(now);
+            return true;
+        }
+        // DHCP renewal can hand out a different address without the link dropping.
+        // Checked against the raw address so the string is only formatted on a change.
+        if (refresh_ip())
+        {
+            printf("IP address changed: %s\n", ip_str);
+            return true;
+        }
+        return false;
+
+    case WIFI_LINK_JOINING:
+    {
+        if (tcpip_status == CYW43_LINK_UP)
+        {
+            link_up(now);
+            return true;
+        }
+
+        // FAIL, NONET and BADAUTH are all negative
+        int wifi_status = cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA);
+        if (wifi_status < 0 || (now - join_start_ms) > JOIN_TIMEOUT_MS)
+        {
+            schedule_retry(now);
+            printf("Wi-Fi join failed (status %d), retrying in %lu ms\n",
+                   wifi_status, (unsigned long)backoff_ms);
+            return true;
+        }
+        return false;
+    }
+
+    case WIFI_LINK_DOWN:
+        // The driver may have rejoined on its own
+        if (tcpip_status == CYW43_LINK_UP)
+        {
+            link_up(now);
+            return true;
+        }
+        if ((int32_t)(now - next_attempt_ms) >= 0)
+        {
+            start_join(now);
+            return true;
+        }
+        return false;
+    }
+
+    return false;
+}
+
+// Call once per sensor reading so samples kept during an outage are counted
+void wifi_link_record_sample(void)
+{
+    if (state == WIFI_LINK_UP)
+        return;
+
+    cyw43_arch_lwip_begin();
+    stats.outage_samples++;
+    stats.total_outage_samples++;
+    current_outage()->samples++;
+    cyw43_arch_lwip_end();
+}
+
+wifi_link_state wifi_link_get_state(void)
+{
+    return state;
+}
+
+const wifi_link_stats *wifi_link_get_stats(void)
+{
+    return &stats;
+}
+
+// Outage record by age, 0 is the current or most recent outage
+// Returns null if fewer outages than that have happened or it was overwritten
+// Outside the lwIP context, hold cyw43_arch_lwip_begin() while reading the record
+const wifi_outage_record *wifi_link_get_outage(uint32_t age)
+{
+    if (age >= stats.outages || age >= WIFI_LINK_OUTAGE_HISTORY)
+        return nullptr;
+
+    return &outages[(stats.outages - 1 - age) % WIFI_LINK_OUTAGE_HISTORY];
+}
+
+// Dotted quad of the current address, empty string while the link is down
+const char *wifi_link_ip_str(void)
+{
+    return ip_str;
+}
+
+// Time left before the next join attempt, 0 unless the link is down
+uint32_t wifi_link_retry_in_ms(void)
+{
+    if (state != WIFI_LINK_DOWN)
+        return 0;
+
+    int32_t remaining = (int32_t)(next_attempt_ms - now_ms());
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "pico/stdlib.h"
+
+enum wifi_link_state
+{
+    WIFI_LINK_DOWN,    // not associated, waiting for the next reconnect attempt
+    WIFI_LINK_JOINING, // join issued, waiting for association and an IP address
+    WIFI_LINK_UP       // associated and has an IP address
+};
+
+// How many recent outages are kept for /link, older ones are overwritten
+#define WIFI_LINK_OUTAGE_HISTORY 8
+
+// One outage, from losing the link (or starting the first join) to getting an IP back
+struct wifi_outage_record
+{
+    uint32_t start_ms;    // ms since boot when the outage began
+    uint32_t duration_ms; // time to reconnect, 0 while the outage is still ongoing
+    uint32_t samples;     // sensor readings taken while offline
+};
+
+// Recovery metrics, all times in ms
+struct wifi_link_stats
+{
+    uint32_t outages;               // number of times the link has been lost (a failed first join counts as one)
+    uint32_t reconnect_attempts;    // total join attempts made by the supervisor
+    uint32_t last_reconnect_ms;     // time from link loss to link up for the most recent outage
+    uint32_t longest_reconnect_ms;  // worst time to reconnect seen so far
+    uint32_t outage_samples;        // samples taken during the current (or most recent) outage
+    uint32_t total_outage_samples;  // samples taken while offline across all outages
+};
+
+void wifi_link_init(const char *ssid, const char *pass, uint32_t boot_join_ms);
+bool wifi_link_poll(void);
+void wifi_link_record_sample(void);
+wifi_link_state wifi_link_get_state(void);
+const wifi_link_stats *wifi_link_get_stats(void);
+const wifi_outage_record *wifi_link_get_outage(uint32_t age);
+const char *wifi_link_ip_str(void);
+uint32_t wifi_link_retry_in_ms(void);